@@ -0,0 +1,576 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "vec3.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 가속 구조 (Bounding Volume Hierarchy)
+//
+// bvh_node: 노드마다 shared_ptr로 자식을 가리키는 이진 트리.
+// wide_bvh: 아주 큰 장면을 위한 4진 트리. 노드 하나가 캐시 라인 하나(64바이트)에
+//           들어가고, 자식 상자는 노드 기준 8비트로 양자화되어 있다.
+//           노드는 깊이 우선 순서로 한 배열에 놓이며, 파일로 저장했다가
+//           다시 만들지 않고 그대로 메모리에 매핑해서 쓸 수 있다.
+
+// 물체들의 [begin, end) 구간을 상자 중심이 가장 넓게 퍼진 축의 중앙값으로
+// 나눈다. centroid(i)는 i번째 물체의 상자 중심.
+template <typename T, typename F>
+size_t split_median(std::vector<T> &items, size_t begin, size_t end,
+                    F centroid) {
+  point3 lo = centroid(items[begin]), hi = lo;
+  for (size_t i = begin + 1; i < end; i++) {
+    auto c = centroid(items[i]);
+    for (int a = 0; a < 3; a++) {
+      lo[a] = fmin(lo[a], c[a]);
+      hi[a] = fmax(hi[a], c[a]);
+    }
+  }
+
+  auto extent = hi - lo;
+  int axis = 0;
+  if (extent[1] > extent[axis])
+    axis = 1;
+  if (extent[2] > extent[axis])
+    axis = 2;
+
+  auto mid = begin + (end - begin) / 2;
+  std::nth_element(items.begin() + begin, items.begin() + mid,
+                   items.begin() + end, [&](const T &a, const T &b) {
+                     return centroid(a)[axis] < centroid(b)[axis];
+                   });
+  return mid;
+}
+
+inline point3 box_centroid(const aabb &box) {
+  return 0.5 * (box.min() + box.max());
+}
+
+class bvh_node : public hittable {
+public:
+  bvh_node() {}
+  // list는 값으로 받아서 한 번만 복사하고, 그 배열을 제자리에서 나눈다.
+  bvh_node(hittable_list list)
+      : bvh_node(list.objects, 0, list.objects.size()) {}
+  bvh_node(std::vector<shared_ptr<hittable>> &objects, size_t start,
+           size_t end);
+
+  virtual bool hit(const ray &r, double t_min, double t_max,
+                   hit_record &rec) const override;
+  virtual bool bounding_box(aabb &output_box) const override;
+  virtual double transmittance(const ray &r, double t_min,
+                               double t_max) const override;
+
+public:
+  shared_ptr<hittable> left;
+  shared_ptr<hittable> right;
+  aabb box;
+};
+
+bvh_node::bvh_node(std::vector<shared_ptr<hittable>> &objects, size_t start,
+                   size_t end) {
+  size_t object_span = end - start;
+  if (object_span == 0) {
+    // 빈 트리: 자식이 없고 아무것도 맞지 않는다.
+    return;
+  } else if (object_span == 1) {
+    left = right = objects[start];
+  } else if (object_span == 2) {
+    left = objects[start];
+    right = objects[start + 1];
+  } else {
+    auto mid = split_median(objects, start, end,
+                            [](const shared_ptr<hittable> &h) {
+                              aabb b;
+                              h->bounding_box(b);
+                              return box_centroid(b);
+                            });
+    left = make_shared<bvh_node>(objects, start, mid);
+    right = make_shared<bvh_node>(objects, mid, end);
+  }
+
+  aabb box_left, box_right;
+  if (!left->bounding_box(box_left) || !right->bounding_box(box_right))
+    std::cerr << "No bounding box in bvh_node constructor.\n";
+  box = surrounding_box(box_left, box_right);
+}
+
+bool bvh_node::hit(const ray &r, double t_min, double t_max,
+                   hit_record &rec) const {
+  if (!left || !box.hit(r, t_min, t_max))
+    return false;
+
+  bool hit_left = left->hit(r, t_min, t_max, rec);
+  bool hit_right = right->hit(r, t_min, hit_left ? rec.t : t_max, rec);
+
+  return hit_left || hit_right;
+}
+
+bool bvh_node::bounding_box(aabb &output_box) const {
+  output_box = box;
+  return left != nullptr;
+}
+
+double bvh_node::transmittance(const ray &r, double t_min,
+                               double t_max) const {
+  if (!left || !box.hit(r, t_min, t_max))
+    return 1.0;
+  auto tr = left->transmittance(r, t_min, t_max);
+  if (tr <= 0 || left == right)
+    return tr;
+  return tr * right->transmittance(r, t_min, t_max);
+}
+
+// wide_bvh의 노드. 크기와 정렬이 정확히 캐시 라인 하나다.
+//
+// 자식 c의 상자는 origin + q * 2^exponent (축마다) 로 복원한다.
+// 양자화는 항상 바깥쪽으로 반올림하므로 복원한 상자는 원래 상자를 감싼다.
+// prim_count[c]가 0이면 child[c]는 노드 번호, 아니면 child[c]부터
+// prim_count[c]개의 물체 참조가 잎(leaf)이다.
+struct alignas(64) wide_bvh_node {
+  static const int width = 4;
+
+  float origin[3];
+  int8_t exponent[3];
+  uint8_t child_count;
+  uint8_t qmin[3][width];
+  uint8_t qmax[3][width];
+  uint32_t child[width];
+  uint8_t prim_count[width];
+  uint8_t pad[4];
+};
+
+static_assert(sizeof(wide_bvh_node) == 64,
+              "wide_bvh_node must fill a cache line");
+
+class wide_bvh : public hittable {
+public:
+  static const int max_leaf_size = 4;
+  // traverse()의 스택(64칸)이 넘치지 않는 트리 깊이
+  static const int max_depth = 20;
+
+  // list의 물체들로 트리를 만든다. list는 wide_bvh보다 오래 살아야 한다.
+  wide_bvh(const hittable_list &list);
+  ~wide_bvh();
+
+  wide_bvh(const wide_bvh &) = delete;
+  wide_bvh &operator=(const wide_bvh &) = delete;
+
+  // 트리를 파일로 저장한다. 물체 자체는 저장하지 않는다.
+  bool save(const std::string &path) const;
+  // save로 저장한 파일을 메모리에 매핑한다. list는 저장할 때와 같은 순서의
+  // 같은 물체들이어야 한다. 파일이 맞지 않으면 nullptr을 돌려준다.
+  static shared_ptr<wide_bvh> load(const std::string &path,
+                                   const hittable_list &list);
+
+  virtual bool hit(const ray &r, double t_min, double t_max,
+                   hit_record &rec) const override;
+  virtual bool bounding_box(aabb &output_box) const override;
+  virtual double transmittance(const ray &r, double t_min,
+                               double t_max) const override;
+
+  size_t node_count() const { return num_nodes; }
+  size_t ref_count() const { return num_refs; }
+  // 트리가 차지하는 바이트 수 (노드 + 물체 참조)
+  size_t memory_bytes() const {
+    return num_nodes * sizeof(wide_bvh_node) + num_refs * sizeof(uint32_t);
+  }
+
+private:
+  struct build_prim {
+    aabb box;
+    point3 centroid;
+    uint32_t index;
+  };
+
+  // 파일 앞부분의 헤더. 노드들이 64바이트 경계에서 시작하도록
+  // 캐시 라인 두 개 크기로 채운다.
+  static const size_t header_size = 2 * sizeof(wide_bvh_node);
+  struct file_header {
+    char magic[8];
+    uint64_t node_count;
+    uint64_t ref_count;
+    uint64_t object_count;
+    double bounds_min[3];
+    double bounds_max[3];
+  };
+
+  wide_bvh(const hittable_list &list, int) : objects(list.objects) {}
+
+  uint32_t build(std::vector<build_prim> &prims, size_t begin, size_t end);
+  // 파일에서 읽은 노드와 물체 참조가 모두 범위 안에 있는지 확인한다.
+  bool valid() const;
+
+  // 광선이 지나는 잎의 물체 번호마다 leaf(index, t_max)를 가까운 순서대로
+  // 부른다. leaf는 t_max를 줄일 수 있고, false를 돌려주면 탐색을 멈춘다.
+  template <typename F>
+  void traverse(const ray &r, double t_min, double &t_max, F leaf) const;
+
+  const std::vector<shared_ptr<hittable>> &objects;
+  aabb bounds;
+
+  // 노드와 물체 참조는 build_nodes/build_refs에 있거나 매핑한 파일 안에 있다.
+  const wide_bvh_node *nodes = nullptr;
+  const uint32_t *refs = nullptr;
+  size_t num_nodes = 0;
+  size_t num_refs = 0;
+
+  std::vector<wide_bvh_node> build_nodes;
+  std::vector<uint32_t> build_refs;
+  void *mapped = nullptr;
+  size_t mapped_size = 0;
+};
+
+static const char wide_bvh_magic[8] = {'W', 'B', 'V', 'H', '0', '0', '0', '1'};
+
+wide_bvh::wide_bvh(const hittable_list &list) : objects(list.objects) {
+  std::vector<build_prim> prims(objects.size());
+  for (size_t i = 0; i < objects.size(); i++) {
+    objects[i]->bounding_box(prims[i].box);
+    prims[i].centroid = box_centroid(prims[i].box);
+    prims[i].index = static_cast<uint32_t>(i);
+  }
+
+  list.bounding_box(bounds);
+  build(prims, 0, prims.size());
+
+  nodes = build_nodes.data();
+  refs = build_refs.data();
+  num_nodes = build_nodes.size();
+  num_refs = build_refs.size();
+}
+
+wide_bvh::~wide_bvh() {
+#ifndef _WIN32
+  if (mapped)
+    munmap(mapped, mapped_size);
+#endif
+}
+
+uint32_t wide_bvh::build(std::vector<build_prim> &prims, size_t begin,
+                         size_t end) {
+  // 물체가 가장 많은 구간을 반씩 나누어 자식이 최대 width개가 되게 한다.
+  std::vector<std::pair<size_t, size_t>> ranges;
+  if (end > begin)
+    ranges.push_back({begin, end});
+
+  while (ranges.size() < wide_bvh_node::width) {
+    size_t widest = 0;
+    for (size_t i = 1; i < ranges.size(); i++)
+      if (ranges[i].second - ranges[i].first >
+          ranges[widest].second - ranges[widest].first)
+        widest = i;
+    if (ranges.empty() ||
+        ranges[widest].second - ranges[widest].first <= max_leaf_size)
+      break;
+
+    auto range = ranges[widest];
+    auto mid = split_median(prims, range.first, range.second,
+                            [](const build_prim &p) { return p.centroid; });
+    ranges[widest] = {range.first, mid};
+    ranges.insert(ranges.begin() + widest + 1, {mid, range.second});
+  }
+
+  // 노드 자리를 먼저 잡아서 부모가 자식들보다 앞에 오게 한다 (깊이 우선).
+  auto node_index = static_cast<uint32_t>(build_nodes.size());
+  build_nodes.emplace_back();
+
+  wide_bvh_node node;
+  std::memset(&node, 0, sizeof(node));
+  node.child_count = static_cast<uint8_t>(ranges.size());
+
+  aabb child_box[wide_bvh_node::width];
+  for (size_t c = 0; c < ranges.size(); c++) {
+    auto first = ranges[c].first, last = ranges[c].second;
+    child_box[c] = prims[first].box;
+    for (auto i = first + 1; i < last; i++)
+      child_box[c] = surrounding_box(child_box[c], prims[i].box);
+
+    if (last - first <= max_leaf_size) {
+      node.child[c] = static_cast<uint32_t>(build_refs.size());
+      node.prim_count[c] = static_cast<uint8_t>(last - first);
+      for (auto i = first; i < last; i++)
+        build_refs.push_back(prims[i].index);
+    } else {
+      node.child[c] = build(prims, first, last);
+    }
+  }
+
+  if (!ranges.empty()) {
+    aabb box = child_box[0];
+    for (size_t c = 1; c < ranges.size(); c++)
+      box = surrounding_box(box, child_box[c]);
+
+    for (int a = 0; a < 3; a++) {
+      // float로 내림해서 원점이 상자 밖으로 나가지 않게 한다.
+      const float infinity_f = std::numeric_limits<float>::infinity();
+      float origin = static_cast<float>(box.min()[a]);
+      if (origin > box.min()[a])
+        origin = std::nextafter(origin, -infinity_f);
+
+      // 254칸이면 상자 전체를 덮도록 2의 거듭제곱 크기를 고른다.
+      auto extent = box.max()[a] - origin;
+      int e = extent > 0 ? static_cast<int>(ceil(log2(extent / 254))) : -100;
+      e = std::min(std::max(e, -100), 100);
+      float scale = std::ldexp(1.0f, e);
+
+      node.origin[a] = origin;
+      node.exponent[a] = static_cast<int8_t>(e);
+      for (size_t c = 0; c < ranges.size(); c++) {
+        // 복원할 때와 같은 float 연산으로 확인하면서 바깥쪽으로 맞춘다.
+        auto cmin = child_box[c].min()[a], cmax = child_box[c].max()[a];
+        int lo = static_cast<int>(floor((cmin - origin) / scale));
+        int hi = static_cast<int>(ceil((cmax - origin) / scale));
+        lo = std::min(std::max(lo, 0), 255);
+        hi = std::min(std::max(hi, 0), 255);
+        while (lo > 0 && origin + lo * scale > cmin)
+          lo--;
+        while (hi < 255 && origin + hi * scale < cmax)
+          hi++;
+        node.qmin[a][c] = static_cast<uint8_t>(lo);
+        node.qmax[a][c] = static_cast<uint8_t>(hi);
+      }
+    }
+  }
+
+  build_nodes[node_index] = node;
+  return node_index;
+}
+
+template <typename F>
+void wide_bvh::traverse(const ray &r, double t_min, double &t_max,
+                        F leaf) const {
+  if (num_nodes == 0)
+    return;
+
+  float org[3], inv[3];
+  for (int a = 0; a < 3; a++) {
+    org[a] = static_cast<float>(r.origin()[a]);
+    inv[a] = static_cast<float>(1.0 / r.direction()[a]);
+  }
+
+  // 노드 하나가 자식을 최대 width개 쌓으므로 깊이가 max_depth 이하면
+  // 64칸이면 충분하다. 트리의 깊이는 log4(물체 수) 정도다.
+  uint32_t stack[64];
+  int top = 0;
+  stack[top++] = 0;
+
+  while (top > 0) {
+    const auto &node = nodes[stack[--top]];
+    float scale[3];
+    for (int a = 0; a < 3; a++)
+      scale[a] = std::ldexp(1.0f, node.exponent[a]);
+
+    // 광선과 만나는 자식들을 들어가는 거리 순서로 모은다.
+    int order[wide_bvh_node::width];
+    float t_enter[wide_bvh_node::width];
+    int hits = 0;
+
+    for (int c = 0; c < node.child_count; c++) {
+      float t0 = static_cast<float>(t_min), t1 = static_cast<float>(t_max);
+      for (int a = 0; a < 3; a++) {
+        float lo = node.origin[a] + node.qmin[a][c] * scale[a];
+        float hi = node.origin[a] + node.qmax[a][c] * scale[a];
+        float near = (lo - org[a]) * inv[a];
+        float far = (hi - org[a]) * inv[a];
+        if (inv[a] < 0)
+          std::swap(near, far);
+        // float 반올림 때문에 경계의 물체를 놓치지 않도록 조금 넓힌다.
+        far *= 1.0000004f;
+        t0 = near > t0 ? near : t0;
+        t1 = far < t1 ? far : t1;
+      }
+      if (t0 > t1)
+        continue;
+
+      int k = hits++;
+      while (k > 0 && t_enter[k - 1] > t0) {
+        order[k] = order[k - 1];
+        t_enter[k] = t_enter[k - 1];
+        k--;
+      }
+      order[k] = c;
+      t_enter[k] = t0;
+    }
+
+    // 잎은 바로 검사하고, 안쪽 노드는 먼 것부터 쌓아서 가까운 것이 먼저 나오게 한다.
+    for (int k = 0; k < hits; k++) {
+      int c = order[k];
+      if (node.prim_count[c] == 0 || t_enter[k] > t_max)
+        continue;
+      for (uint32_t i = 0; i < node.prim_count[c]; i++)
+        if (!leaf(refs[node.child[c] + i], t_max))
+          return;
+    }
+    for (int k = hits - 1; k >= 0; k--) {
+      int c = order[k];
+      if (node.prim_count[c] == 0 && t_enter[k] <= t_max)
+        stack[top++] = node.child[c];
+    }
+  }
+}
+
+bool wide_bvh::hit(const ray &r, double t_min, double t_max,
+                   hit_record &rec) const {
+  bool hit_anything = false;
+  hit_record temp_rec;
+
+  traverse(r, t_min, t_max, [&](uint32_t index, double &closest_so_far) {
+    if (objects[index]->hit(r, t_min, closest_so_far, temp_rec)) {
+      hit_anything = true;
+      closest_so_far = temp_rec.t;
+      rec = temp_rec;
+    }
+    return true;
+  });
+
+  return hit_anything;
+}
+
+bool wide_bvh::bounding_box(aabb &output_box) const {
+  output_box = bounds;
+  return num_nodes > 0;
+}
+
+double wide_bvh::transmittance(const ray &r, double t_min,
+                               double t_max) const {
+  double tr = 1.0;
+  traverse(r, t_min, t_max, [&](uint32_t index, double &) {
+    tr *= objects[index]->transmittance(r, t_min, t_max);
+    return tr > 0;
+  });
+  return tr > 0 ? tr : 0.0;
+}
+
+// 파일 구조: file_header (header_size 바이트), 노드 배열, 물체 참조 배열
+bool wide_bvh::save(const std::string &path) const {
+  std::ofstream out(path, std::ios::binary);
+  if (!out)
+    return false;
+
+  file_header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, wide_bvh_magic, sizeof(header.magic));
+  header.node_count = num_nodes;
+  header.ref_count = num_refs;
+  header.object_count = objects.size();
+  for (int a = 0; a < 3; a++) {
+    header.bounds_min[a] = bounds.min()[a];
+    header.bounds_max[a] = bounds.max()[a];
+  }
+
+  char block[header_size] = {};
+  std::memcpy(block, &header, sizeof(header));
+  out.write(block, sizeof(block));
+  out.write(reinterpret_cast<const char *>(nodes),
+            num_nodes * sizeof(wide_bvh_node));
+  out.write(reinterpret_cast<const char *>(refs), num_refs * sizeof(uint32_t));
+  return static_cast<bool>(out);
+}
+
+shared_ptr<wide_bvh> wide_bvh::load(const std::string &path,
+                                    const hittable_list &list) {
+  static_assert(sizeof(file_header) <= header_size,
+                "file_header must fit in the header block");
+
+  shared_ptr<wide_bvh> bvh(new wide_bvh(list, 0));
+  const char *data = nullptr;
+  size_t size = 0;
+
+#ifndef _WIN32
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)header_size) {
+    close(fd);
+    return nullptr;
+  }
+  size = static_cast<size_t>(st.st_size);
+  void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED)
+    return nullptr;
+  bvh->mapped = p;
+  bvh->mapped_size = size;
+  data = static_cast<const char *>(p);
+#else
+  // mmap이 없으면 읽어서 (64바이트로 정렬된) 노드 배열에 담는다.
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  if (!in)
+    return nullptr;
+  size = static_cast<size_t>(in.tellg());
+  if (size < header_size)
+    return nullptr;
+  bvh->build_nodes.resize((size + sizeof(wide_bvh_node) - 1) /
+                          sizeof(wide_bvh_node));
+  in.seekg(0);
+  in.read(reinterpret_cast<char *>(bvh->build_nodes.data()), size);
+  data = reinterpret_cast<const char *>(bvh->build_nodes.data());
+#endif
+
+  file_header header;
+  std::memcpy(&header, data, sizeof(header));
+  if (header.node_count > size / sizeof(wide_bvh_node) ||
+      header.ref_count > size / sizeof(uint32_t))
+    return nullptr;
+  auto expected = header_size +
+                  header.node_count * sizeof(wide_bvh_node) +
+                  header.ref_count * sizeof(uint32_t);
+  if (std::memcmp(header.magic, wide_bvh_magic, sizeof(header.magic)) != 0 ||
+      header.object_count != list.objects.size() || expected != size)
+    return nullptr;
+
+  bvh->bounds =
+      aabb(point3(header.bounds_min[0], header.bounds_min[1],
+                  header.bounds_min[2]),
+           point3(header.bounds_max[0], header.bounds_max[1],
+                  header.bounds_max[2]));
+  bvh->num_nodes = header.node_count;
+  bvh->num_refs = header.ref_count;
+  bvh->nodes = reinterpret_cast<const wide_bvh_node *>(data + header_size);
+  bvh->refs = reinterpret_cast<const uint32_t *>(
+      data + header_size + header.node_count * sizeof(wide_bvh_node));
+  if (!bvh->valid())
+    return nullptr;
+  return bvh;
+}
+
+bool wide_bvh::valid() const {
+  for (size_t i = 0; i < num_refs; i++)
+    if (refs[i] >= objects.size())
+      return false;
+
+  // 깊이 우선 순서라서 자식은 항상 부모보다 뒤에 있다. 그래서 앞에서부터
+  // 한 번 훑으면 순환이 없는지와 깊이를 함께 확인할 수 있다.
+  std::vector<uint8_t> depth(num_nodes, 0);
+  for (size_t i = 0; i < num_nodes; i++) {
+    const auto &node = nodes[i];
+    if (node.child_count > wide_bvh_node::width)
+      return false;
+    for (int c = 0; c < node.child_count; c++) {
+      if (node.prim_count[c] == 0) {
+        auto child = node.child[c];
+        if (child <= i || child >= num_nodes || depth[i] >= max_depth)
+          return false;
+        depth[child] = static_cast<uint8_t>(depth[i] + 1);
+      } else if (uint64_t(node.child[c]) + node.prim_count[c] > num_refs) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,320 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "vec3.h"
+
+#include <typeinfo>
+
+// 정책(policy)으로 특수화한 렌더링 루프
+//
+// render_kernel<Camera, Integrator, Sampler, Scene>은 카메라 종류, 적분기,
+// 샘플러, 장면 탐색 방법을 템플릿 인자로 받는다. 흔한 조합은 미리 만들어
+// 두고 select_kernel()이 설정과 장면을 보고 실행 중에 하나를 고른다.
+// 예를 들어 조리개가 0이면 렌즈 샘플링을 하지 않는 카메라를,
+// 장면이 lambertian만 쓰면 가상 함수 호출 없이 lambertian::scatter를
+// 바로 부르는 적분기를 쓴다. 장면이 구만으로 된 hittable_list이면 구들을
+// 평평한 배열로 훑는다. 이것은 가속 구조 없는 O(N) 탐색이므로 물체가
+// 많은 장면에서는 bvh_node나 wide_bvh로 감싸 기본 장면 정책을 쓰는 편이 낫다.
+
+struct render_settings {
+  int image_width;
+  int image_height;
+  int samples_per_pixel;
+  int max_depth;
+  bool stratified = false;   // 픽셀 안을 격자로 나누어 샘플링
+  bool diffuse_only = false; // 재질 대신 ray_color_diffuse처럼 회색 확산만
+  bool progress = false;     // 남은 행 수를 std::cerr에 찍는다
+};
+
+// 카메라 정책
+
+struct thin_lens_camera {
+  static ray get_ray(const camera &cam, double s, double t) {
+    return cam.get_ray(s, t);
+  }
+};
+
+struct pinhole_camera {
+  static ray get_ray(const camera &cam, double s, double t) {
+    return cam.get_pinhole_ray(s, t);
+  }
+};
+
+// 샘플러 정책: 픽셀 안에서 s번째 샘플의 위치 [0, 1)^2
+
+struct random_sampler {
+  static void jitter(int, int, double &dx, double &dy) {
+    dx = random_double();
+    dy = random_double();
+  }
+};
+
+struct stratified_sampler {
+  static void jitter(int s, int spp, double &dx, double &dy) {
+    int n = static_cast<int>(sqrt(double(spp)));
+    if (s >= n * n) {
+      // 격자에 들어가지 않고 남은 샘플
+      dx = random_double();
+      dy = random_double();
+      return;
+    }
+    dx = (s % n + random_double()) / n;
+    dy = (s / n + random_double()) / n;
+  }
+};
+
+// 재질 정책: 장면에 쓰이는 재질의 집합
+
+struct any_material {
+  static bool scatter(const material &m, const ray &r_in,
+                      const hit_record &rec, color &attenuation,
+                      ray &scattered) {
+    return m.scatter(r_in, rec, attenuation, scattered);
+  }
+};
+
+// 장면의 모든 재질이 M일 때만 쓴다. M::scatter로 부르면 가상 함수 호출을
+// 거치지 않고 인라인될 수 있다.
+template <typename M> struct only_material {
+  static bool scatter(const material &m, const ray &r_in,
+                      const hit_record &rec, color &attenuation,
+                      ray &scattered) {
+    return static_cast<const M &>(m).M::scatter(r_in, rec, attenuation,
+                                                 scattered);
+  }
+};
+
+// 장면 정책: 광선과 가장 가까운 물체와 그 재질을 찾는다.
+
+// 물체가 모두 구인 hittable_list인지
+inline bool is_sphere_list(const hittable_list &world) {
+  for (const auto &object : world.objects)
+    if (!object || typeid(*object) != typeid(sphere))
+      return false;
+  return true;
+}
+
+// 어떤 hittable이든 world.hit으로
+struct any_scene {
+  any_scene(const hittable &w) : world(w) {}
+
+  bool hit(const ray &r, double t_min, double t_max, hit_record &rec,
+           const material *&mat) const {
+    if (!world.hit(r, t_min, t_max, rec))
+      return false;
+    mat = rec.mat_ptr.get();
+    return true;
+  }
+
+  const hittable &world;
+};
+
+// 물체가 모두 구인 hittable_list. 구들을 배열로 복사해 두고 sphere::hit과
+// 같은 계산으로 한 번에 훑은 뒤, 가장 가까운 구의 hit_record만 채운다.
+// (rec.mat_ptr은 비워 두고 재질은 mat으로 돌려준다)
+// 그런 장면이 아니면 any_scene처럼 world.hit을 부른다.
+struct sphere_array_scene {
+  struct entry {
+    point3 center;
+    double radius;
+    const material *mat;
+  };
+
+  sphere_array_scene(const hittable &w) : fallback(&w) {
+    auto list = dynamic_cast<const hittable_list *>(&w);
+    if (!list || !is_sphere_list(*list))
+      return;
+    for (const auto &object : list->objects) {
+      auto s = static_cast<const sphere *>(object.get());
+      spheres.push_back({s->center, s->radius, s->mat_ptr.get()});
+    }
+    fallback = nullptr;
+  }
+
+  bool hit(const ray &r, double t_min, double t_max, hit_record &rec,
+           const material *&mat) const {
+    if (fallback) {
+      if (!fallback->hit(r, t_min, t_max, rec))
+        return false;
+      mat = rec.mat_ptr.get();
+      return true;
+    }
+
+    auto a = r.direction().length_squared();
+    const entry *closest = nullptr;
+
+    for (const auto &s : spheres) {
+      vec3 oc = r.origin() - s.center;
+      auto half_b = dot(oc, r.direction());
+      auto c = oc.length_squared() - s.radius * s.radius;
+      auto discriminant = half_b * half_b - a * c;
+      if (discriminant < 0)
+        continue;
+      auto sqrtd = sqrt(discriminant);
+
+      auto root = (-half_b - sqrtd) / a;
+      if (root < t_min || t_max < root) {
+        root = (-half_b + sqrtd) / a;
+        if (root < t_min || t_max < root)
+          continue;
+      }
+      t_max = root;
+      closest = &s;
+    }
+
+    if (!closest)
+      return false;
+    rec.t = t_max;
+    rec.p = r.at(rec.t);
+    rec.set_face_normal(r, (rec.p - closest->center) / closest->radius);
+    mat = closest->mat;
+    return true;
+  }
+
+  std::vector<entry> spheres;
+  const hittable *fallback; // 구 목록이 아니면 이 장면을 그대로 쓴다
+};
+
+// 적분기 정책
+
+inline color sky_color(const ray &r) {
+  vec3 unit_direction = unit_vector(r.direction());
+  auto t = 0.5 * (unit_direction.y() + 1.0);
+  return (1.0 - t) * color(1.0, 1.0, 1.0) + t * color(0.5, 0.7, 1.0);
+}
+
+// ray_color_material과 같지만 재귀 대신 반복문으로 돈다.
+template <typename Materials> struct path_integrator {
+  template <typename Scene>
+  static color trace(ray r, const Scene &scene, int depth) {
+    color throughput(1, 1, 1);
+    for (; depth > 0; --depth) {
+      hit_record rec;
+      const material *mat;
+      if (!scene.hit(r, 0.001, infinity, rec, mat))
+        return throughput * sky_color(r);
+
+      ray scattered;
+      color attenuation;
+      if (!Materials::scatter(*mat, r, rec, attenuation, scattered))
+        return color(0, 0, 0);
+      throughput = throughput * attenuation;
+      r = scattered;
+    }
+    return color(0, 0, 0);
+  }
+};
+
+// ray_color_diffuse와 같다: 재질을 보지 않고 부딪힐 때마다 0.5를 곱한다.
+struct diffuse_integrator {
+  template <typename Scene>
+  static color trace(ray r, const Scene &scene, int depth) {
+    double throughput = 1;
+    for (; depth > 0; --depth) {
+      hit_record rec;
+      const material *mat;
+      if (!scene.hit(r, 0.001, infinity, rec, mat))
+        return throughput * sky_color(r);
+      r = ray(rec.p, rec.normal + random_unit_vector());
+      throughput *= 0.5;
+    }
+    return color(0, 0, 0);
+  }
+};
+
+// pixels[j * image_width + i]에 샘플의 합을 쓴다 (j = 0이 아래 행).
+template <typename Camera, typename Integrator, typename Sampler,
+          typename Scene>
+void render_kernel(const render_settings &rs, const camera &cam,
+                   const hittable &world, std::vector<color> &pixels) {
+  Scene scene(world);
+  pixels.resize(rs.image_width * rs.image_height);
+  int remaining = rs.image_height;
+
+  // 위쪽 행부터 렌더링한다.
+#pragma omp parallel for schedule(dynamic)
+  for (int k = 0; k < rs.image_height; ++k) {
+    int j = rs.image_height - 1 - k;
+    for (int i = 0; i < rs.image_width; ++i) {
+      color pixel_color(0, 0, 0);
+      for (int s = 0; s < rs.samples_per_pixel; ++s) {
+        double dx, dy;
+        Sampler::jitter(s, rs.samples_per_pixel, dx, dy);
+        auto u = (i + dx) / (rs.image_width - 1);
+        auto v = (j + dy) / (rs.image_height - 1);
+        pixel_color +=
+            Integrator::trace(Camera::get_ray(cam, u, v), scene, rs.max_depth);
+      }
+      pixels[j * rs.image_width + i] = pixel_color;
+    }
+
+    if (rs.progress) {
+#pragma omp critical
+      std::cerr << "\rScanlines remaining: " << --remaining << ' '
+                << std::flush;
+    }
+  }
+}
+
+using render_kernel_function = void (*)(const render_settings &,
+                                        const camera &, const hittable &,
+                                        std::vector<color> &);
+
+// 아무 설정에서나 쓸 수 있는 기본 커널
+constexpr render_kernel_function generic_kernel =
+    render_kernel<thin_lens_camera, path_integrator<any_material>,
+                  random_sampler, any_scene>;
+
+// 장면이 M 재질만 쓰는지. 구가 아닌 물체가 있으면 알 수 없으므로 false.
+// only_material<M>은 M::scatter를 바로 부르므로 M을 상속한 재질도 안 된다.
+template <typename M> bool uses_only_material(const hittable_list &world) {
+  for (const auto &object : world.objects) {
+    auto s = dynamic_cast<const sphere *>(object.get());
+    if (!s || !s->mat_ptr || typeid(*s->mat_ptr) != typeid(M))
+      return false;
+  }
+  return true;
+}
+
+namespace detail {
+
+template <typename Camera, typename Integrator, typename Sampler>
+render_kernel_function pick_scene(bool sphere_list) {
+  if (sphere_list)
+    return render_kernel<Camera, Integrator, Sampler, sphere_array_scene>;
+  return render_kernel<Camera, Integrator, Sampler, any_scene>;
+}
+
+template <typename Camera, typename Integrator>
+render_kernel_function pick_sampler(const render_settings &rs,
+                                    bool sphere_list) {
+  if (rs.stratified)
+    return pick_scene<Camera, Integrator, stratified_sampler>(sphere_list);
+  return pick_scene<Camera, Integrator, random_sampler>(sphere_list);
+}
+
+template <typename Camera>
+render_kernel_function pick_integrator(const render_settings &rs,
+                                       const hittable_list &world) {
+  bool sphere_list = is_sphere_list(world);
+  if (rs.diffuse_only)
+    return pick_sampler<Camera, diffuse_integrator>(rs, sphere_list);
+  if (uses_only_material<lambertian>(world))
+    return pick_sampler<Camera, path_integrator<only_material<lambertian>>>(
+        rs, sphere_list);
+  return pick_sampler<Camera, path_integrator<any_material>>(rs, sphere_list);
+}
+
+} // namespace detail
+
+// 설정과 장면에 맞는 가장 특수화된 커널을 고른다.
+// 고른 커널은 world와 같은 장면으로 불러야 한다.
+render_kernel_function select_kernel(const render_settings &rs,
+                                     const camera &cam,
+                                     const hittable_list &world) {
+  if (cam.is_pinhole())
+    return detail::pick_integrator<pinhole_camera>(rs, world);
+  return detail::pick_integrator<thin_lens_camera>(rs, world);
+}
+
+#endif
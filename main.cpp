@@ -1,4 +1,13 @@
 #include "vec3.h"
+#include "bvh.h"
+#include "kernels.h"
+#include "preview.h"
+#include "render.h"
+#include "volume.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 
 // int main() {
@@ -139,6 +148,49 @@ color ray_color_material(const ray &r, const hittable &world, int depth) {
   return (1.0 - t) * color(1.0, 1.0, 1.0) + t * color(0.5, 0.7, 1.0);
 }
 
+// 매질이 있는 장면을 위한 적분기
+// 매질이나 lambertian 표면에서 산란될 때마다 태양을 향해 그림자 광선을 쏘고
+// (next event estimation), 그 투과율은 world.transmittance로 추정한다.
+color ray_color_volume(const ray &r, const hittable &world,
+                       const directional_light &sun, int depth) {
+  hit_record rec;
+
+  if (depth <= 0)
+    return color(0, 0, 0);
+
+  if (world.hit(r, 0.001, infinity, rec)) {
+    ray scattered;
+    color attenuation;
+    if (!rec.mat_ptr->scatter(r, rec, attenuation, scattered))
+      return color(0, 0, 0);
+
+    // 태양 쪽으로 나가는 빛의 비율. attenuation (albedo)은 아래에서 곱한다.
+    //  - 매질: 위상 함수 값
+    //  - lambertian: BRDF albedo / pi 중 1 / pi 에 cos theta를 곱한 값
+    // metal, dielectric은 거의 거울이라 방향광을 샘플링하지 않는다.
+    double f = 0;
+    if (auto phase = dynamic_cast<const phase_function *>(rec.mat_ptr.get()))
+      f = phase->p(r.direction(), sun.direction);
+    else if (dynamic_cast<const lambertian *>(rec.mat_ptr.get()))
+      f = fmax(0.0, dot(rec.normal, sun.direction)) / pi;
+
+    color direct(0, 0, 0);
+    if (f > 0) {
+      ray shadow(rec.p, sun.direction);
+      auto tr = world.transmittance(shadow, 0.001, infinity);
+      if (tr > 0)
+        direct = f * tr * sun.radiance;
+    }
+
+    return attenuation *
+           (direct + ray_color_volume(scattered, world, sun, depth - 1));
+  }
+
+  vec3 unit_direction = unit_vector(r.direction());
+  auto t = 0.5 * (unit_direction.y() + 1.0);
+  return (1.0 - t) * color(1.0, 1.0, 1.0) + t * color(0.5, 0.7, 1.0);
+}
+
 hittable_list random_scene() {
   hittable_list world;
 
@@ -185,7 +237,486 @@ hittable_list random_scene() {
   return world;
 }
 
-int main() {
+// random_scene()을 엷은 안개로 채우고 큰 구들 주변에 연기를 띄운다.
+hittable_list fog_scene() {
+  auto world = random_scene();
+
+  auto fog_boundary = make_shared<sphere>(point3(0, 0, 0), 40);
+  world.add(make_shared<constant_medium>(
+      fog_boundary, 0.03, make_shared<henyey_greenstein>(color(1, 1, 1), 0.6)));
+
+  // 연기: 가우시안 덩어리 몇 개를 복셀 격자에 찍는다.
+  // 덩어리 밖은 0으로 잘라서 대부분의 벽돌이 비어 있게 한다.
+  const int n = 96;
+  auto smoke = make_shared<grid_medium>(
+      aabb(point3(-6, 0, -4), point3(6, 6, 4)), n, n, n,
+      make_shared<isotropic>(color(0.8, 0.8, 0.8)));
+
+  std::vector<point3> puffs;
+  std::vector<double> radii;
+  for (int i = 0; i < 10; i++) {
+    puffs.push_back(point3(random_double(-4, 4), random_double(1.5, 4),
+                           random_double(-2, 2)));
+    radii.push_back(random_double(0.5, 1.2));
+  }
+
+  auto lo = smoke->bounds.min();
+  auto extent = smoke->bounds.max() - lo;
+  for (int z = 0; z < n; z++)
+    for (int y = 0; y < n; y++)
+      for (int x = 0; x < n; x++) {
+        point3 p = lo + vec3((x + 0.5) / n * extent.x(),
+                             (y + 0.5) / n * extent.y(),
+                             (z + 0.5) / n * extent.z());
+        double d = 0;
+        for (size_t i = 0; i < puffs.size(); i++) {
+          auto r2 = (p - puffs[i]).length_squared() / (radii[i] * radii[i]);
+          if (r2 < 4)
+            d += 6.0 * exp(-r2);
+        }
+        smoke->set(x, y, z, d);
+      }
+  world.add(smoke);
+
+  return world;
+}
+
+// 안개 장면 벤치마크
+// 같은 카메라로 안개가 없는 장면, 균질 안개, 균질 안개 + 연기(큰 벽돌과
+// 벽돌 두 단계 majorant / 벽돌별 majorant / 전체 majorant 하나)를
+// 렌더링하고 걸린 시간을 비교한다.
+void bench_fog() {
+  const auto aspect_ratio = 16.0 / 9.0;
+  const int image_width = 240;
+  const int image_height = static_cast<int>(image_width / aspect_ratio);
+  const int samples_per_pixel = 8;
+  const int max_depth = 16;
+
+  camera cam(point3(13, 2, 3), point3(0, 0, 0), vec3(0, 1, 0), 20,
+             aspect_ratio, 0.1, 10.0);
+  directional_light sun{unit_vector(vec3(-1, 2, 1)), color(3, 2.8, 2.5)};
+
+  auto run = [&](const char *name, const hittable &world) {
+    auto start = std::chrono::steady_clock::now();
+    double sum = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+ : sum)
+    for (int j = 0; j < image_height; ++j) {
+      for (int i = 0; i < image_width; ++i) {
+        for (int s = 0; s < samples_per_pixel; ++s) {
+          auto u = (i + random_double()) / (image_width - 1);
+          auto v = (j + random_double()) / (image_height - 1);
+          auto c = ray_color_volume(cam.get_ray(u, v), world, sun, max_depth);
+          sum += c.x() + c.y() + c.z();
+        }
+      }
+    }
+    std::chrono::duration<double, std::milli> ms =
+        std::chrono::steady_clock::now() - start;
+    auto paths = double(image_width) * image_height * samples_per_pixel;
+    std::cerr << name << ": " << ms.count() << " ms, "
+              << ms.count() * 1e6 / paths << " ns/path, mean radiance "
+              << sum / (3 * paths) << '\n';
+  };
+
+  std::cerr << image_width << 'x' << image_height << ", "
+            << samples_per_pixel << " spp, max_depth " << max_depth << '\n';
+
+  // 같은 장면에서 매질만 하나씩 더해 가며 잰다.
+  auto world = fog_scene();
+  auto smoke = std::dynamic_pointer_cast<grid_medium>(world.objects.back());
+  auto surfaces = world.objects.size() - 2;
+
+  hittable_list clear, fog;
+  for (size_t i = 0; i < surfaces; i++)
+    clear.add(world.objects[i]);
+  fog = clear;
+  fog.add(world.objects[surfaces]);
+
+  run("random_scene", clear);
+  run("fog (constant_medium)", fog);
+
+  std::cerr << "smoke: " << smoke->allocated_bricks() << " bricks allocated\n";
+  run("fog + smoke (super-brick + brick majorants)", world);
+  smoke->super_bricks = false;
+  run("fog + smoke (brick majorants)", world);
+  smoke->brick_majorants = false;
+  run("fog + smoke (global majorant)", world);
+}
+
+// 자주 쓰는 여러 시점: 스테레오 한 쌍, 썸네일, 장면 가운데에서 본 라이트 프로브
+void add_views(render_job &job) {
+  const auto aspect_ratio = 16.0 / 9.0;
+  point3 lookfrom(13, 2, 3);
+  point3 lookat(0, 0, 0);
+  vec3 vup(0, 1, 0);
+  auto dist_to_focus = 10.0;
+  auto aperture = 0.1;
+
+  // 눈 사이 거리만큼 카메라 오른쪽 방향으로 벌린다.
+  vec3 right = unit_vector(cross(lookat - lookfrom, vup));
+  auto eye = 0.065 * 4;
+  job.add(camera(lookfrom - eye / 2 * right, lookat, vup, 20, aspect_ratio,
+                 aperture, dist_to_focus),
+          320, 180, 8);
+  job.add(camera(lookfrom + eye / 2 * right, lookat, vup, 20, aspect_ratio,
+                 aperture, dist_to_focus),
+          320, 180, 8);
+  job.add(camera(lookfrom, lookat, vup, 20, aspect_ratio, aperture,
+                 dist_to_focus),
+          160, 90, 8);
+  job.add(camera(point3(0, 3, 0), point3(1, 0.5, 0), vup, 90, 1.0, 0.0, 1.0),
+          96, 96, 16);
+}
+
+// 시점 여러 개를 한 번에 렌더링해서 view0.ppm, view1.ppm, ... 로 저장한다.
+void render_multiview() {
+  const int max_depth = 50;
+  auto world = random_scene();
+
+  render_job job;
+  add_views(job);
+
+  job.render([&](const ray &r) {
+    return ray_color_material(r, world, max_depth);
+  });
+
+  for (size_t v = 0; v < job.views.size(); v++) {
+    std::ofstream out("view" + std::to_string(v) + ".ppm");
+    job.views[v].write_ppm(out);
+  }
+  std::cerr << "Wrote " << job.views.size() << " views.\n";
+}
+
+// 여러 시점을 렌더링하는 세 가지 방법을 비교한다.
+//  - separate:   시점마다 따로 실행하듯이 장면을 만들고 렌더링
+//  - sequential: 장면은 한 번만 만들고 시점을 하나씩 차례로 렌더링
+//  - batched:    장면은 한 번만 만들고 모든 시점의 타일을 섞어서 렌더링
+// 장면은 매번 같은 seed로 만들어서 모두 같은 장면을 렌더링한다.
+// 기계의 잡음을 줄이려고 번갈아 두 번씩 돌려서 짧은 쪽을 쓴다.
+void bench_multiview() {
+  const int max_depth = 50;
+  const unsigned scene_seed = 42;
+  using clock = std::chrono::steady_clock;
+  using ms = std::chrono::duration<double, std::milli>;
+
+  render_job all;
+  add_views(all);
+
+  auto build = [&] {
+    seed_random(scene_seed);
+    return random_scene();
+  };
+  auto render_one = [&](const render_view &view, const hittable &world) {
+    render_job one;
+    one.add(view.cam, view.image_width, view.image_height,
+            view.samples_per_pixel);
+    one.render([&](const ray &r) {
+      return ray_color_material(r, world, max_depth);
+    });
+  };
+
+  double separate = infinity, sequential = infinity, batched = infinity;
+  for (int k = 0; k < 2; k++) {
+    auto start = clock::now();
+    for (const auto &view : all.views) {
+      auto world = build();
+      render_one(view, world);
+    }
+    separate = fmin(separate, ms(clock::now() - start).count());
+
+    start = clock::now();
+    {
+      auto world = build();
+      for (const auto &view : all.views)
+        render_one(view, world);
+    }
+    sequential = fmin(sequential, ms(clock::now() - start).count());
+
+    start = clock::now();
+    {
+      auto world = build();
+      all.render([&](const ray &r) {
+        return ray_color_material(r, world, max_depth);
+      });
+    }
+    batched = fmin(batched, ms(clock::now() - start).count());
+  }
+
+  std::cerr << all.views.size() << " views\n"
+            << "separate:   " << separate << " ms\n"
+            << "sequential: " << sequential << " ms\n"
+            << "batched:    " << batched << " ms\n"
+            << "batched / separate = " << batched / separate
+            << " (target: well below 1)\n"
+            << "batched / sequential = " << batched / sequential
+            << " (gain from interleaving tiles)\n";
+}
+
+// 가속 구조 벤치마크
+// 작은 구 n개를 흩어 놓고 이진 트리(bvh_node)와 wide_bvh의 물체당 메모리,
+// 만드는 시간, 같은 광선들을 추적하는 시간을 비교한다.
+// wide_bvh는 파일로 저장했다가 매핑해서 다시 쓰는 것도 잰다.
+void bench_bvh(int n) {
+  using clock = std::chrono::steady_clock;
+  using ms = std::chrono::duration<double, std::milli>;
+
+  hittable_list spheres;
+  auto mat = make_shared<lambertian>(color(0.5, 0.5, 0.5));
+  auto side = cbrt(double(n));
+  for (int i = 0; i < n; i++)
+    spheres.add(make_shared<sphere>(vec3::random(0, side),
+                                    random_double(0.1, 0.4), mat));
+
+  const int num_rays = 500000;
+  std::vector<ray> rays;
+  for (int i = 0; i < num_rays; i++)
+    rays.push_back(ray(vec3::random(0, side), random_unit_vector()));
+
+  auto trace = [&](const char *name, const hittable &world) {
+    auto start = clock::now();
+    long hits = 0;
+    double sum = 0;
+#pragma omp parallel for schedule(dynamic, 1024) reduction(+ : hits, sum)
+    for (int i = 0; i < num_rays; i++) {
+      hit_record rec;
+      if (world.hit(rays[i], 0.001, infinity, rec)) {
+        hits++;
+        sum += rec.t;
+      }
+    }
+    ms elapsed = clock::now() - start;
+    std::cerr << name << ": " << elapsed.count() << " ms, "
+              << elapsed.count() * 1e6 / num_rays << " ns/ray (" << hits
+              << " hits, sum t " << sum << ")\n";
+  };
+
+  std::cerr << n << " spheres, " << num_rays << " rays\n";
+
+  auto start = clock::now();
+  auto binary = make_shared<bvh_node>(spheres);
+  ms binary_build = clock::now() - start;
+
+  // 안쪽 노드 수를 센다. make_shared는 제어 블록(16바이트)을 함께 할당한다.
+  size_t binary_nodes = 0;
+  std::vector<const bvh_node *> todo{binary.get()};
+  while (!todo.empty()) {
+    auto node = todo.back();
+    todo.pop_back();
+    binary_nodes++;
+    for (auto child : {node->left, node->right})
+      if (auto c = dynamic_cast<const bvh_node *>(child.get()))
+        if (child != node->right || node->left != node->right)
+          todo.push_back(c);
+  }
+  auto binary_bytes = binary_nodes * (sizeof(bvh_node) + 16);
+
+  start = clock::now();
+  wide_bvh wide(spheres);
+  ms wide_build = clock::now() - start;
+
+  std::cerr << "bvh_node: build " << binary_build.count() << " ms, "
+            << binary_nodes << " nodes, " << double(binary_bytes) / n
+            << " bytes/prim\n"
+            << "wide_bvh: build " << wide_build.count() << " ms, "
+            << wide.node_count() << " nodes, "
+            << double(wide.memory_bytes()) / n << " bytes/prim\n";
+
+  trace("bvh_node", *binary);
+  trace("wide_bvh", wide);
+
+  const char *path = "bench_bvh.wbvh";
+  start = clock::now();
+  wide.save(path);
+  ms save_time = clock::now() - start;
+  start = clock::now();
+  auto mapped = wide_bvh::load(path, spheres);
+  ms load_time = clock::now() - start;
+  std::cerr << "save " << save_time.count() << " ms, load "
+            << load_time.count() << " ms\n";
+  if (mapped)
+    trace("wide_bvh (mapped)", *mapped);
+  else
+    std::cerr << "load failed\n";
+  std::remove(path);
+}
+
+// 미리보기 벤치마크
+// random_scene()을 600px 미리보기로 열고, 첫 이미지까지의 시간, 카메라를
+// 움직였을 때 새 이미지까지의 시간, 일부 영역만 다듬는 시간을 잰다.
+void bench_preview() {
+  using clock = std::chrono::steady_clock;
+  using ms = std::chrono::duration<double, std::milli>;
+  const std::chrono::milliseconds timeout(60000);
+
+  const auto aspect_ratio = 16.0 / 9.0;
+  const int image_width = 600;
+  const int image_height = static_cast<int>(image_width / aspect_ratio);
+  const int max_depth = 50;
+
+  auto world = random_scene();
+  camera_params params{point3(13, 2, 3), point3(0, 0, 0), vec3(0, 1, 0), 20,
+                       aspect_ratio, 0.1, 10.0};
+
+  auto start = clock::now();
+  preview_session preview(
+      image_width, image_height, 16,
+      [&](const ray &r) { return ray_color_material(r, world, max_depth); },
+      params);
+  uint64_t gen = 1;
+
+  auto report = [&](const char *what, bool ok) {
+    ms elapsed = clock::now() - start;
+    std::cerr << what << ": " << elapsed.count() << " ms"
+              << (ok ? "" : " (timed out)") << '\n';
+  };
+
+  std::cerr << image_width << 'x' << image_height << " preview\n";
+  report("first image (1/8 res)", preview.wait_for_pass(gen, 8, timeout));
+  report("1/2 res", preview.wait_for_pass(gen, 2, timeout));
+  report("first full-res pass", preview.wait_for_pass(gen, 1, timeout));
+
+  // 아직 다듬는 중에 카메라를 옮긴다.
+  params.lookfrom = point3(12, 2.5, 4);
+  start = clock::now();
+  gen = preview.set_camera(params);
+  report("camera moved, first image", preview.wait_for_pass(gen, 8, timeout));
+
+  region crop{250, 120, 350, 200};
+  start = clock::now();
+  gen = preview.set_region(crop);
+  report("crop 100x80, 16 spp", preview.wait_until_done(gen, timeout));
+
+  // 카메라를 그대로 다시 주면 쌓인 샘플이 남아 있어야 한다.
+  gen = preview.set_camera(params);
+  std::cerr << "same camera again: crop keeps " << preview.region_spp()
+            << " spp\n";
+}
+
+// random_scene()과 배치는 같고 모든 구가 lambertian인 장면
+hittable_list diffuse_scene() {
+  auto world = random_scene();
+  for (auto &object : world.objects) {
+    auto s = std::dynamic_pointer_cast<sphere>(object);
+    if (!std::dynamic_pointer_cast<lambertian>(s->mat_ptr))
+      s->mat_ptr = make_shared<lambertian>(color::random(0.2, 0.8));
+  }
+  return world;
+}
+
+// 특수화한 커널 벤치마크
+// 정책을 하나씩 바꾼 커널과 select_kernel()이 모두 합쳐 고른 커널을 기본
+// 커널(generic_kernel)과 같은 장면, 같은 카메라로 번갈아 여러 번 돌리고
+// 가장 짧은 시간을 비교한다. 장면은 가속 구조 없는 물체 목록이다.
+void bench_kernels() {
+  using clock = std::chrono::steady_clock;
+  using ms = std::chrono::duration<double, std::milli>;
+
+  const auto aspect_ratio = 16.0 / 9.0;
+  const int image_width = 160;
+  const int image_height = static_cast<int>(image_width / aspect_ratio);
+  const int max_depth = 50;
+
+  auto mixed = random_scene();
+  auto diffuse = diffuse_scene();
+  point3 lookfrom(13, 2, 3);
+  point3 lookat(0, 0, 0);
+  vec3 vup(0, 1, 0);
+  camera lens(lookfrom, lookat, vup, 20, aspect_ratio, 0.1, 10.0);
+  camera pinhole(lookfrom, lookat, vup, 20, aspect_ratio, 0.0, 10.0);
+
+  auto time = [&](render_kernel_function kernel, const render_settings &rs,
+                  const camera &cam, const hittable &world) {
+    std::vector<color> pixels;
+    auto start = clock::now();
+    kernel(rs, cam, world, pixels);
+    return ms(clock::now() - start).count();
+  };
+
+  render_settings rs{image_width, image_height, 8, max_depth};
+  render_settings all = rs;
+  all.stratified = true;
+
+  struct variant {
+    const char *name;
+    render_kernel_function kernel;
+    const render_settings &rs;
+    const camera &cam;
+    const hittable_list &world;
+  };
+  variant variants[] = {
+      {"pinhole camera",
+       render_kernel<pinhole_camera, path_integrator<any_material>,
+                     random_sampler, any_scene>,
+       rs, pinhole, mixed},
+      {"lambertian only",
+       render_kernel<thin_lens_camera,
+                     path_integrator<only_material<lambertian>>,
+                     random_sampler, any_scene>,
+       rs, lens, diffuse},
+      {"stratified sampler",
+       render_kernel<thin_lens_camera, path_integrator<any_material>,
+                     stratified_sampler, any_scene>,
+       rs, lens, mixed},
+      // 재질 대신 회색 확산만 하므로 기본 커널과 다른 이미지가 나온다.
+      {"diffuse integrator",
+       render_kernel<thin_lens_camera, diffuse_integrator, random_sampler,
+                     any_scene>,
+       rs, lens, mixed},
+      {"sphere array (O(N) scan)",
+       render_kernel<thin_lens_camera, path_integrator<any_material>,
+                     random_sampler, sphere_array_scene>,
+       rs, lens, mixed},
+      {"select_kernel: pinhole, lambertian only, stratified, sphere array",
+       select_kernel(all, pinhole, diffuse), all, pinhole, diffuse},
+  };
+
+  std::cerr << image_width << 'x' << image_height << ", 8 spp, max_depth "
+            << max_depth << ", " << mixed.objects.size() << " spheres\n";
+  for (const auto &v : variants) {
+    double generic = infinity, special = infinity;
+    for (int k = 0; k < 5; k++) {
+      generic = fmin(generic, time(generic_kernel, v.rs, v.cam, v.world));
+      special = fmin(special, time(v.kernel, v.rs, v.cam, v.world));
+    }
+    std::cerr << v.name << ": generic " << generic << " ms, specialized "
+              << special << " ms (" << generic / special << "x)\n";
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "--bench-fog") == 0) {
+    bench_fog();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "--bench-multiview") == 0) {
+    bench_multiview();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "--bench-bvh") == 0) {
+    long n = 1000000;
+    if (argc > 2) {
+      char *end;
+      n = strtol(argv[2], &end, 10);
+      if (*end != '\0' || n <= 0 || n > std::numeric_limits<int>::max()) {
+        std::cerr << "--bench-bvh: sphere count must be a positive integer\n";
+        return 1;
+      }
+    }
+    bench_bvh(static_cast<int>(n));
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "--bench-preview") == 0) {
+    bench_preview();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "--bench-kernels") == 0) {
+    bench_kernels();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "--multiview") == 0) {
+    render_multiview();
+    return 0;
+  }
 
   // Image
 
@@ -252,32 +783,18 @@ int main() {
   //       origin - horizontal / 2 - vertical / 2 - vec3(0, 0, focal_length);
 
   // Render
-  std::cout << "P3\n" << image_width << " " << image_height << "\n255\n";
+  // 조리개, 장면의 재질에 맞게 특수화된 렌더링 루프를 고른다.
+  render_settings settings{image_width, image_height, samples_per_pixel,
+                           max_depth};
+  settings.progress = true;
+  auto kernel = select_kernel(settings, cam, world);
+  std::vector<color> pixels;
+  kernel(settings, cam, world, pixels);
 
-  for (int j = image_height - 1; j >= 0; --j) {
-    std::cerr << "\rScanlines remaining: " << j << ' ' << std::flush;
-    color colors[image_width];
-#pragma omp parallel for
-    for (int i = 0; i < image_width; ++i) {
-      //   auto u = double(i) / (image_width - 1);
-      //   auto v = double(j) / (image_height - 1);
-      //   ray r(origin, lower_left_corner + u * horizontal + v * vertical -
-      //   origin); color pixel_color = ray_color(r, world);
-      //   write_color(std::cout, pixel_color);
-      color pixel_color(0, 0, 0);
-      for (int s = 0; s < samples_per_pixel; ++s) {
-        auto u = (i + random_double()) / (image_width - 1);
-        auto v = (j + random_double()) / (image_height - 1);
-        ray r = cam.get_ray(u, v);
-        pixel_color += ray_color_material(r, world, max_depth);
-      }
-      colors[i] = pixel_color;
-    }
-
-    for (int i = 0; i < image_width; ++i) {
-      write_color(std::cout, colors[i], samples_per_pixel);
-    }
-  }
+  std::cout << "P3\n" << image_width << " " << image_height << "\n255\n";
+  for (int j = image_height - 1; j >= 0; --j)
+    for (int i = 0; i < image_width; ++i)
+      write_color(std::cout, pixels[j * image_width + i], samples_per_pixel);
 
   std::cerr << "\nDone.\n";
-}
\ No newline at end of file
+}
@@ -0,0 +1,322 @@
+#ifndef PREVIEW_H
+#define PREVIEW_H
+
+#include "vec3.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// 카메라를 만지작거리는 동안 쓰는 빠른 미리보기
+//
+// preview_session은 뒤에서 스레드 하나를 돌리며 이미지를 점점 다듬는다.
+//  1. 해상도 사다리: 8x8, 4x4, 2x2 픽셀 덩어리마다 광선 하나씩 (1 spp)
+//  2. 그 다음에는 전체 해상도로 한 번에 1 spp씩 max_spp까지 쌓는다.
+// 낮은 해상도의 샘플도 그 샘플이 떨어진 픽셀에 쌓이므로 버려지지 않는다.
+//
+// set_camera()는 진행 중인 패스를 바로 취소한다 (각 행을 시작하기 전에 확인).
+// 카메라가 바뀌면 쌓인 샘플과 낮은 해상도 값을 모두 지우므로, 영역 밖
+// 픽셀은 이전 카메라의 이미지 대신 검게 보인다. 카메라가 그대로면 쌓인
+// 샘플을 유지하고, set_region()으로 일부 영역만 렌더링하게 바꿀 때도 이미
+// 쌓인 샘플은 그대로 둔다.
+
+// 카메라를 다시 만들 수 있는 값들
+struct camera_params {
+  point3 lookfrom;
+  point3 lookat;
+  vec3 vup;
+  double vfov;
+  double aspect_ratio;
+  double aperture;
+  double dist_to_focus;
+
+  camera make() const {
+    return camera(lookfrom, lookat, vup, vfov, aspect_ratio, aperture,
+                  dist_to_focus);
+  }
+
+  bool operator==(const camera_params &o) const {
+    for (int a = 0; a < 3; a++)
+      if (lookfrom[a] != o.lookfrom[a] || lookat[a] != o.lookat[a] ||
+          vup[a] != o.vup[a])
+        return false;
+    return vfov == o.vfov && aspect_ratio == o.aspect_ratio &&
+           aperture == o.aperture && dist_to_focus == o.dist_to_focus;
+  }
+};
+
+// 렌더링할 픽셀 영역 [x0, x1) x [y0, y1). y는 이미지 위쪽에서부터 센다.
+struct region {
+  int x0, y0, x1, y1;
+};
+
+class preview_session {
+public:
+  using shade_function = std::function<color(const ray &)>;
+
+  // shade는 뒤의 스레드들에서 동시에 불린다. 장면을 바꾸면 안 된다.
+  preview_session(int width, int height, int max_spp, shade_function shade,
+                  const camera_params &params);
+  ~preview_session();
+
+  preview_session(const preview_session &) = delete;
+  preview_session &operator=(const preview_session &) = delete;
+
+  // 새 세대(generation) 번호를 돌려준다.
+  uint64_t set_camera(const camera_params &params);
+  uint64_t set_region(const region &r);
+  uint64_t clear_region() { return set_region({0, 0, width, height}); }
+
+  // 세대 gen에서 scale 이하 해상도 패스가 끝날 때까지 기다린다.
+  // (scale 1은 전체 해상도) 시간 안에 끝나면 true.
+  bool wait_for_pass(uint64_t gen, int scale,
+                     std::chrono::milliseconds timeout);
+  // 세대 gen에서 영역 안의 모든 픽셀이 max_spp가 될 때까지 기다린다.
+  bool wait_until_done(uint64_t gen, std::chrono::milliseconds timeout);
+
+  // 지금까지의 이미지. 샘플이 없는 픽셀은 낮은 해상도 패스의 값으로 채운다.
+  // 아래 행부터 (j = 0) 저장되어 있다.
+  std::vector<color> snapshot() const;
+  void write_ppm(std::ostream &out) const;
+
+  // 영역 안 픽셀들의 최소 샘플 수
+  int region_spp() const;
+
+public:
+  const int width;
+  const int height;
+  const int max_spp;
+
+  // 해상도 사다리. 마지막은 항상 1 (전체 해상도)
+  static constexpr int ladder[] = {8, 4, 2, 1};
+
+private:
+  void run();
+  // 패스 하나. 취소되었으면 false.
+  bool render_pass(const camera &cam, const region &roi, int scale,
+                   uint64_t gen);
+  bool cancelled(uint64_t gen) const { return generation.load() != gen; }
+
+  shade_function shade;
+
+  mutable std::mutex mutex;
+  std::condition_variable work_cv;
+  mutable std::condition_variable pass_cv;
+
+  // mutex로 보호되는 상태
+  camera_params params;
+  region roi;
+  std::atomic<uint64_t> generation{1};
+  uint64_t finished_gen = 0; // 이 세대의 일은 모두 끝났다
+  int finished_scale = 0;    // 이 세대에서 끝난 가장 고운 패스 (0: 없음)
+  bool stop = false;
+
+  std::vector<color> accum;   // 픽셀마다 샘플 합
+  std::vector<int> count;     // 픽셀마다 샘플 수
+  std::vector<color> coarse;  // 낮은 해상도 패스가 덩어리에 채운 값
+
+  std::thread worker;
+};
+
+preview_session::preview_session(int w, int h, int spp, shade_function f,
+                                 const camera_params &p)
+    : width(w), height(h), max_spp(spp), shade(std::move(f)), params(p),
+      roi{0, 0, w, h}, accum(w * h), count(w * h, 0), coarse(w * h) {
+  worker = std::thread([this] { run(); });
+}
+
+preview_session::~preview_session() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+    generation++;
+  }
+  work_cv.notify_all();
+  worker.join();
+}
+
+uint64_t preview_session::set_camera(const camera_params &p) {
+  uint64_t gen;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!(p == params)) {
+      params = p;
+      std::fill(accum.begin(), accum.end(), color(0, 0, 0));
+      std::fill(count.begin(), count.end(), 0);
+      std::fill(coarse.begin(), coarse.end(), color(0, 0, 0));
+    }
+    gen = ++generation;
+    finished_scale = 0;
+  }
+  work_cv.notify_all();
+  return gen;
+}
+
+uint64_t preview_session::set_region(const region &r) {
+  uint64_t gen;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    roi = {std::max(r.x0, 0), std::max(r.y0, 0), std::min(r.x1, width),
+           std::min(r.y1, height)};
+    gen = ++generation;
+    finished_scale = 0;
+  }
+  work_cv.notify_all();
+  return gen;
+}
+
+bool preview_session::wait_for_pass(uint64_t gen, int scale,
+                                    std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(mutex);
+  return pass_cv.wait_for(lock, timeout, [&] {
+    return generation.load() != gen ||
+           (finished_scale != 0 && finished_scale <= scale) ||
+           finished_gen == gen;
+  }) && generation.load() == gen;
+}
+
+bool preview_session::wait_until_done(uint64_t gen,
+                                      std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(mutex);
+  return pass_cv.wait_for(lock, timeout, [&] {
+    return generation.load() != gen || finished_gen == gen;
+  }) && generation.load() == gen;
+}
+
+std::vector<color> preview_session::snapshot() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<color> image(width * height);
+  for (size_t k = 0; k < image.size(); k++)
+    image[k] = count[k] > 0 ? accum[k] / count[k] : coarse[k];
+  return image;
+}
+
+void preview_session::write_ppm(std::ostream &out) const {
+  auto image = snapshot();
+  out << "P3\n" << width << " " << height << "\n255\n";
+  for (int j = height - 1; j >= 0; --j)
+    for (int i = 0; i < width; ++i)
+      write_color(out, image[j * width + i], 1);
+}
+
+int preview_session::region_spp() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  int spp = max_spp;
+  for (int y = roi.y0; y < roi.y1; y++) {
+    int j = height - 1 - y;
+    for (int i = roi.x0; i < roi.x1; i++)
+      spp = std::min(spp, count[j * width + i]);
+  }
+  return spp;
+}
+
+void preview_session::run() {
+  while (true) {
+    camera_params p;
+    region r;
+    uint64_t gen;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      work_cv.wait(lock, [&] { return stop || finished_gen != generation; });
+      if (stop)
+        return;
+      p = params;
+      r = roi;
+      gen = generation;
+    }
+
+    auto cam = p.make();
+    bool ok = true;
+    for (int scale : ladder) {
+      if (scale == 1)
+        break;
+      if (!(ok = render_pass(cam, r, scale, gen)))
+        break;
+    }
+    for (int pass = 0; ok && pass < max_spp; pass++)
+      ok = render_pass(cam, r, 1, gen);
+
+    if (ok) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (generation == gen)
+        finished_gen = gen;
+      pass_cv.notify_all();
+    }
+  }
+}
+
+bool preview_session::render_pass(const camera &cam, const region &r,
+                                  int scale, uint64_t gen) {
+  // 덩어리 (scale x scale)마다 광선 하나. 결과는 pass에 모았다가
+  // 패스가 끝나면 한꺼번에 합친다.
+  int bx0 = r.x0 / scale, bx1 = (r.x1 + scale - 1) / scale;
+  int by0 = r.y0 / scale, by1 = (r.y1 + scale - 1) / scale;
+  int bw = bx1 - bx0, bh = by1 - by0;
+  if (bw <= 0 || bh <= 0)
+    return true;
+
+  struct sample {
+    int i, j;      // 샘플이 떨어진 픽셀
+    bool needed;   // 이 픽셀에 샘플이 더 필요했는지
+    color c;
+  };
+  std::vector<sample> pass(bw * bh);
+
+  // 이미 샘플이 쌓인 픽셀이나 max_spp에 이른 픽셀은 건너뛴다.
+  std::vector<int> count_copy;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    count_copy = count;
+  }
+
+#pragma omp parallel for schedule(dynamic)
+  for (int by = by0; by < by1; ++by) {
+    if (cancelled(gen))
+      continue;
+    for (int bx = bx0; bx < bx1; ++bx) {
+      auto &s = pass[(by - by0) * bw + bx - bx0];
+      int x = std::min(bx * scale + int(random_double() * scale), width - 1);
+      int y = std::min(by * scale + int(random_double() * scale), height - 1);
+      s.i = x;
+      s.j = height - 1 - y;
+      auto n = count_copy[s.j * width + s.i];
+      s.needed = scale == 1 ? n < max_spp : n == 0;
+      if (!s.needed)
+        continue;
+
+      auto u = (s.i + random_double()) / (width - 1);
+      auto v = (s.j + random_double()) / (height - 1);
+      s.c = shade(cam.get_ray(u, v));
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (cancelled(gen))
+    return false;
+
+  for (int by = by0; by < by1; ++by) {
+    for (int bx = bx0; bx < bx1; ++bx) {
+      const auto &s = pass[(by - by0) * bw + bx - bx0];
+      if (!s.needed)
+        continue;
+      accum[s.j * width + s.i] += s.c;
+      count[s.j * width + s.i]++;
+
+      // 아직 샘플이 없는 픽셀은 덩어리의 값으로 보여 준다.
+      for (int y = by * scale; y < std::min((by + 1) * scale, height); y++)
+        for (int x = bx * scale; x < std::min((bx + 1) * scale, width); x++)
+          coarse[(height - 1 - y) * width + x] = s.c;
+    }
+  }
+
+  if (finished_scale == 0 || scale < finished_scale)
+    finished_scale = scale;
+  pass_cv.notify_all();
+  return true;
+}
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "vec3.h"
+
+#include <algorithm>
+
+// 여러 카메라로 같은 장면을 한 번에 렌더링하기
+//
+// 뷰(render_view)마다 카메라, 해상도, 샘플 수가 다를 수 있다.
+// render_job은 모든 뷰의 이미지를 타일로 자르고, 뷰들의 타일을 번갈아
+// 섞은 하나의 목록을 OpenMP 스레드들이 나누어 처리한다.
+// 장면은 읽기만 하므로 모든 스레드와 모든 뷰가 같은 장면을 공유하고,
+// 작은 뷰가 먼저 끝나도 남은 스레드가 다른 뷰의 타일을 가져가서 놀지 않는다.
+
+struct render_view {
+  render_view(const camera &c, int width, int height, int spp)
+      : cam(c), image_width(width), image_height(height),
+        samples_per_pixel(spp), pixels(width * height) {}
+
+  // PPM으로 내보낸다. 행은 위에서부터 (j = image_height - 1) 쓴다.
+  void write_ppm(std::ostream &out) const {
+    out << "P3\n" << image_width << " " << image_height << "\n255\n";
+    for (int j = image_height - 1; j >= 0; --j)
+      for (int i = 0; i < image_width; ++i)
+        write_color(out, pixels[j * image_width + i], samples_per_pixel);
+  }
+
+  camera cam;
+  int image_width;
+  int image_height;
+  int samples_per_pixel;
+  // 샘플의 합 (write_color가 samples_per_pixel로 나눈다)
+  std::vector<color> pixels;
+};
+
+class render_job {
+public:
+  static const int tile_size = 32;
+
+  // 뷰를 추가하고 그 번호를 돌려준다.
+  int add(const camera &cam, int width, int height, int spp) {
+    views.emplace_back(cam, width, height, spp);
+    return static_cast<int>(views.size()) - 1;
+  }
+
+  // shade(ray)는 광선 하나의 색을 돌려주는 함수. 여러 스레드에서 동시에
+  // 불리므로 장면을 바꾸면 안 된다.
+  template <typename F> void render(F shade);
+
+public:
+  std::vector<render_view> views;
+
+private:
+  struct tile {
+    int view;
+    int x0, y0, x1, y1;
+  };
+
+  // 뷰마다 타일을 만든 뒤 뷰를 돌아가며 하나씩 꺼내 섞는다.
+  std::vector<tile> interleaved_tiles() const;
+};
+
+std::vector<render_job::tile> render_job::interleaved_tiles() const {
+  std::vector<std::vector<tile>> per_view(views.size());
+  for (size_t v = 0; v < views.size(); v++) {
+    const auto &view = views[v];
+    for (int y = 0; y < view.image_height; y += tile_size)
+      for (int x = 0; x < view.image_width; x += tile_size)
+        per_view[v].push_back({static_cast<int>(v), x, y,
+                               std::min(x + tile_size, view.image_width),
+                               std::min(y + tile_size, view.image_height)});
+  }
+
+  std::vector<tile> tiles;
+  for (size_t k = 0;; k++) {
+    bool any = false;
+    for (const auto &list : per_view) {
+      if (k < list.size()) {
+        tiles.push_back(list[k]);
+        any = true;
+      }
+    }
+    if (!any)
+      break;
+  }
+  return tiles;
+}
+
+template <typename F> void render_job::render(F shade) {
+  auto tiles = interleaved_tiles();
+
+#pragma omp parallel for schedule(dynamic)
+  for (int k = 0; k < static_cast<int>(tiles.size()); ++k) {
+    const auto &t = tiles[k];
+    auto &view = views[t.view];
+
+    for (int j = t.y0; j < t.y1; ++j) {
+      for (int i = t.x0; i < t.x1; ++i) {
+        color pixel_color(0, 0, 0);
+        for (int s = 0; s < view.samples_per_pixel; ++s) {
+          auto u = (i + random_double()) / (view.image_width - 1);
+          auto v = (j + random_double()) / (view.image_height - 1);
+          pixel_color += shade(view.cam.get_ray(u, v));
+        }
+        view.pixels[j * view.image_width + i] = pixel_color;
+      }
+    }
+  }
+}
+
+#endif
@@ -1,15 +1,17 @@
 #ifndef VEC3_H
-#define VEC3_h
+#define VEC3_H
 
 #include <cmath>
 #include <iostream>
 
 using std::sqrt;
 
+#include <atomic>
 #include <cstdlib>
 #include <random>
 
 #include <memory>
+#include <utility>
 #include <vector>
 
 using std::make_shared;
@@ -20,10 +22,21 @@ using std::shared_ptr;
 //   return rand() / (RAND_MAX + 1.0);
 // }
 
+// 스레드마다 따로 난수 생성기를 둔다. 처음 쓰는 스레드는 기본 seed를 받으므로
+// 스레드 하나로 돌리면 예전과 같은 난수열이 나온다.
+inline std::mt19937 &random_generator() {
+  static std::atomic<unsigned> next_seed{std::mt19937::default_seed};
+  static thread_local std::mt19937 generator(next_seed++);
+  return generator;
+}
+
+// 지금 스레드의 난수열을 seed부터 다시 시작한다.
+inline void seed_random(unsigned seed) { random_generator().seed(seed); }
+
 inline double random_double() {
-  static std::uniform_real_distribution<double> distribution(0.0, 1.0);
-  static std::mt19937 generator;
-  return distribution(generator);
+  static thread_local std::uniform_real_distribution<double> distribution(0.0,
+                                                                          1.0);
+  return distribution(random_generator());
 }
 
 inline double random_double(double min, double max) {
@@ -153,6 +166,51 @@ public:
   vec3 dir;
 };
 
+// 축에 정렬된 상자 (axis-aligned bounding box)
+class aabb {
+public:
+  aabb() {}
+  aabb(const point3 &a, const point3 &b) : minimum(a), maximum(b) {}
+
+  point3 min() const { return minimum; }
+  point3 max() const { return maximum; }
+
+  bool hit(const ray &r, double t_min, double t_max) const {
+    return clip(r, t_min, t_max);
+  }
+
+  // 광선이 상자 안에 머무는 구간으로 [t_min, t_max]를 줄인다.
+  bool clip(const ray &r, double &t_min, double &t_max) const {
+    for (int a = 0; a < 3; a++) {
+      auto invD = 1.0 / r.direction()[a];
+      auto t0 = (minimum[a] - r.origin()[a]) * invD;
+      auto t1 = (maximum[a] - r.origin()[a]) * invD;
+      if (invD < 0.0)
+        std::swap(t0, t1);
+      t_min = t0 > t_min ? t0 : t_min;
+      t_max = t1 < t_max ? t1 : t_max;
+      if (t_max <= t_min)
+        return false;
+    }
+    return true;
+  }
+
+public:
+  point3 minimum;
+  point3 maximum;
+};
+
+// 두 상자를 모두 감싸는 상자
+aabb surrounding_box(const aabb &box0, const aabb &box1) {
+  point3 small(fmin(box0.min().x(), box1.min().x()),
+               fmin(box0.min().y(), box1.min().y()),
+               fmin(box0.min().z(), box1.min().z()));
+  point3 big(fmax(box0.max().x(), box1.max().x()),
+             fmax(box0.max().y(), box1.max().y()),
+             fmax(box0.max().z(), box1.max().z()));
+  return aabb(small, big);
+}
+
 class material;
 struct hit_record {
   // 어떤 지점에서 물체와 만났는지?
@@ -178,6 +236,16 @@ class hittable {
 public:
   virtual bool hit(const ray &r, double t_min, double t_max,
                    hit_record &rec) const = 0;
+  // 물체를 감싸는 상자. 무한한 물체라면 false를 돌려준다.
+  virtual bool bounding_box(aabb &output_box) const = 0;
+
+  // 그림자 광선이 [t_min, t_max] 구간을 지나는 동안 남는 빛의 비율.
+  // 표면은 불투명하므로 부딪히면 0, 아니면 1이다.
+  virtual double transmittance(const ray &r, double t_min,
+                               double t_max) const {
+    hit_record rec;
+    return hit(r, t_min, t_max, rec) ? 0.0 : 1.0;
+  }
 };
 
 class sphere : public hittable {
@@ -189,6 +257,7 @@ public:
 
   virtual bool hit(const ray &r, double t_min, double t_max,
                    hit_record &rec) const override;
+  virtual bool bounding_box(aabb &output_box) const override;
 
 public:
   point3 center;
@@ -228,6 +297,12 @@ bool sphere::hit(const ray &r, double t_min, double t_max,
   return true;
 }
 
+bool sphere::bounding_box(aabb &output_box) const {
+  output_box = aabb(center - vec3(radius, radius, radius),
+                    center + vec3(radius, radius, radius));
+  return true;
+}
+
 class hittable_list : public hittable {
 public:
   hittable_list() {}
@@ -238,6 +313,9 @@ public:
 
   virtual bool hit(const ray &r, double t_min, double t_max,
                    hit_record &rec) const override;
+  virtual bool bounding_box(aabb &output_box) const override;
+  virtual double transmittance(const ray &r, double t_min,
+                               double t_max) const override;
 
 public:
   std::vector<shared_ptr<hittable>> objects;
@@ -262,6 +340,34 @@ bool hittable_list::hit(const ray &r, double t_min, double t_max,
   return hit_anything;
 }
 
+bool hittable_list::bounding_box(aabb &output_box) const {
+  if (objects.empty())
+    return false;
+
+  aabb temp_box;
+  bool first_box = true;
+
+  for (const auto &object : objects) {
+    if (!object->bounding_box(temp_box))
+      return false;
+    output_box = first_box ? temp_box : surrounding_box(output_box, temp_box);
+    first_box = false;
+  }
+
+  return true;
+}
+
+double hittable_list::transmittance(const ray &r, double t_min,
+                                    double t_max) const {
+  double tr = 1.0;
+  for (const auto &object : objects) {
+    tr *= object->transmittance(r, t_min, t_max);
+    if (tr <= 0)
+      return 0.0;
+  }
+  return tr;
+}
+
 #include <limits>
 
 const double infinity = std::numeric_limits<double>::infinity();
@@ -335,6 +441,14 @@ public:
                                     t * vertical - origin - offset);
   }
 
+  // 조리개가 0인 (바늘구멍) 카메라의 광선. 렌즈 샘플링을 건너뛴다.
+  ray get_pinhole_ray(double s, double t) const {
+    return ray(origin,
+               lower_left_corner + s * horizontal + t * vertical - origin);
+  }
+
+  bool is_pinhole() const { return lens_radius == 0; }
+
 private:
   point3 origin;
   point3 lower_left_corner;
@@ -0,0 +1,433 @@
+#ifndef VOLUME_H
+#define VOLUME_H
+
+#include "vec3.h"
+
+#include <algorithm>
+
+// 참여 매질 (안개, 연기)
+//
+// 매질은 hittable처럼 월드에 추가된다. 광선이 매질을 지나는 동안 delta
+// tracking으로 충돌 거리를 고르고, 충돌하면 위상 함수(phase_function)를
+// 재질로 가진 hit_record를 돌려준다. 그림자 광선은 transmittance()로
+// 투과율을 추정한다 (균질 매질은 해석적으로, 불균질 매질은 ratio tracking).
+
+// 위상 함수: 매질 속에서 빛이 어느 방향으로 산란되는지
+class phase_function : public material {
+public:
+  // wi: 들어오는 광선의 진행 방향, wo: 산란된 광선의 진행 방향
+  virtual double p(const vec3 &wi, const vec3 &wo) const = 0;
+};
+
+// 모든 방향으로 똑같이 산란
+class isotropic : public phase_function {
+public:
+  isotropic(const color &a) : albedo(a) {}
+
+  virtual bool scatter(const ray &r_in, const hit_record &rec,
+                       color &attenuation, ray &scattered) const override {
+    scattered = ray(rec.p, random_unit_vector());
+    attenuation = albedo;
+    return true;
+  }
+
+  virtual double p(const vec3 &wi, const vec3 &wo) const override {
+    return 1 / (4 * pi);
+  }
+
+public:
+  color albedo;
+};
+
+// Henyey-Greenstein 위상 함수
+// g > 0 이면 앞쪽으로, g < 0 이면 뒤쪽으로 더 많이 산란된다.
+class henyey_greenstein : public phase_function {
+public:
+  henyey_greenstein(const color &a, double g)
+      : albedo(a), g(clamp(g, -0.99, 0.99)) {}
+
+  virtual bool scatter(const ray &r_in, const hit_record &rec,
+                       color &attenuation, ray &scattered) const override {
+    // 위상 함수 자체를 중요도 샘플링하므로 가중치는 albedo 뿐이다.
+    vec3 w = unit_vector(r_in.direction());
+    double cos_theta;
+    if (fabs(g) < 1e-3) {
+      cos_theta = 1 - 2 * random_double();
+    } else {
+      auto sq = (1 - g * g) / (1 + g - 2 * g * random_double());
+      cos_theta = (1 + g * g - sq * sq) / (2 * g);
+    }
+    auto sin_theta = sqrt(fmax(0.0, 1 - cos_theta * cos_theta));
+    auto phi = 2 * pi * random_double();
+
+    // w를 축으로 하는 정규 직교 기저
+    vec3 a = fabs(w.x()) > 0.9 ? vec3(0, 1, 0) : vec3(1, 0, 0);
+    vec3 u = unit_vector(cross(w, a));
+    vec3 v = cross(w, u);
+
+    scattered = ray(rec.p, sin_theta * cos(phi) * u +
+                               sin_theta * sin(phi) * v + cos_theta * w);
+    attenuation = albedo;
+    return true;
+  }
+
+  virtual double p(const vec3 &wi, const vec3 &wo) const override {
+    auto cos_theta = dot(unit_vector(wi), unit_vector(wo));
+    auto denom = 1 + g * g - 2 * g * cos_theta;
+    return (1 - g * g) / (4 * pi * denom * sqrt(denom));
+  }
+
+public:
+  color albedo;
+  double g;
+};
+
+// 매질 안에서 충돌한 지점의 hit_record를 채운다.
+// 매질에는 표면이 없으므로 법선은 아무 값이나 넣는다.
+inline void set_medium_record(const ray &r, double t,
+                              const shared_ptr<material> &phase,
+                              hit_record &rec) {
+  rec.t = t;
+  rec.p = r.at(t);
+  rec.normal = vec3(1, 0, 0);
+  rec.front_face = true;
+  rec.mat_ptr = phase;
+}
+
+// 밀도가 일정한 매질. boundary는 볼록한 물체여야 한다.
+class constant_medium : public hittable {
+public:
+  constant_medium(shared_ptr<hittable> b, double d, shared_ptr<material> p)
+      : boundary(b), density(d), phase(p) {}
+
+  virtual bool hit(const ray &r, double t_min, double t_max,
+                   hit_record &rec) const override;
+  virtual bool bounding_box(aabb &output_box) const override {
+    return boundary->bounding_box(output_box);
+  }
+  virtual double transmittance(const ray &r, double t_min,
+                               double t_max) const override;
+
+public:
+  shared_ptr<hittable> boundary;
+  double density;
+  shared_ptr<material> phase;
+
+private:
+  // 광선이 boundary 안에 있는 구간을 [t_min, t_max]와 겹쳐서 구한다.
+  bool inside(const ray &r, double &t_min, double &t_max) const;
+};
+
+bool constant_medium::inside(const ray &r, double &t_min,
+                             double &t_max) const {
+  hit_record rec1, rec2;
+
+  if (!boundary->hit(r, -infinity, infinity, rec1))
+    return false;
+  if (!boundary->hit(r, rec1.t + 0.0001, infinity, rec2))
+    return false;
+
+  t_min = fmax(t_min, rec1.t);
+  t_max = fmin(t_max, rec2.t);
+  return t_min < t_max;
+}
+
+bool constant_medium::hit(const ray &r, double t_min, double t_max,
+                          hit_record &rec) const {
+  if (!inside(r, t_min, t_max))
+    return false;
+
+  // 밀도가 일정하면 delta tracking의 상한(majorant)이 곧 밀도이므로
+  // 처음 고른 충돌이 항상 실제 충돌이다.
+  auto ray_length = r.direction().length();
+  auto hit_distance = -log(1 - random_double()) / density;
+  auto t = t_min + hit_distance / ray_length;
+  if (t >= t_max)
+    return false;
+
+  set_medium_record(r, t, phase, rec);
+  return true;
+}
+
+double constant_medium::transmittance(const ray &r, double t_min,
+                                      double t_max) const {
+  if (!inside(r, t_min, t_max))
+    return 1.0;
+  return exp(-density * (t_max - t_min) * r.direction().length());
+}
+
+// 희소 복셀 격자로 표현한 불균질 매질 (연기)
+//
+// 복셀은 brick_size^3 크기의 벽돌 단위로만 저장되고, 밀도가 0인 벽돌은
+// 메모리를 차지하지 않는다. majorant(최대 밀도)는 두 단계로 둔다.
+//  1. 벽돌 super_size^3 개를 묶은 큰 벽돌마다 하나
+//  2. 벽돌마다 하나
+// 광선은 큰 벽돌 격자를 DDA로 지나가며 비어 있는 큰 벽돌은 통째로 건너뛰고,
+// 그 안에서만 벽돌 격자를 DDA로 걷는다. 각 벽돌 안에서는 그 벽돌의
+// majorant로 delta tracking / ratio tracking을 한다.
+class grid_medium : public hittable {
+public:
+  static const int brick_size = 8;
+  static const int super_size = 4; // 큰 벽돌 한 변의 벽돌 수
+
+  grid_medium(const aabb &box, int nx, int ny, int nz,
+              shared_ptr<material> p);
+
+  // 복셀 (ix, iy, iz)의 밀도를 정한다.
+  // majorant는 커지기만 하므로 값을 줄여도 상한으로서 유효하다.
+  void set(int ix, int iy, int iz, double d);
+  double density(const point3 &p) const;
+
+  virtual bool hit(const ray &r, double t_min, double t_max,
+                   hit_record &rec) const override;
+  virtual bool bounding_box(aabb &output_box) const override {
+    output_box = bounds;
+    return true;
+  }
+  virtual double transmittance(const ray &r, double t_min,
+                               double t_max) const override;
+
+  size_t allocated_bricks() const { return voxels.size() / brick_voxels; }
+
+public:
+  aabb bounds;
+  shared_ptr<material> phase;
+  // false 이면 벽돌별 majorant 대신 격자 전체의 최대 밀도 하나만 쓴다.
+  bool brick_majorants = true;
+  // false 이면 큰 벽돌 단계 없이 벽돌 격자만 걷는다.
+  bool super_bricks = true;
+
+private:
+  static const int brick_voxels = brick_size * brick_size * brick_size;
+
+  int brick_index(int bx, int by, int bz) const {
+    return (bz * bricks[1] + by) * bricks[0] + bx;
+  }
+  int super_index(int sx, int sy, int sz) const {
+    return (sz * supers[1] + sy) * supers[0] + sx;
+  }
+
+  // 크기가 extent인 칸들의 격자에서 [lo, hi) 범위의 칸만 [t_min, t_max]
+  // 동안 DDA로 걸으며 f(cell, t0, t1)을 부른다. f가 true면 멈추고 true.
+  template <typename F>
+  bool walk_cells(const ray &r, double t_min, double t_max,
+                  const vec3 &extent, const int lo[3], const int hi[3],
+                  F f) const;
+
+  // [t_min, t_max] 구간을 majorant가 일정한 조각으로 나누어 f(t0, t1, m)을
+  // 부른다. f가 true를 돌려주면 멈춘다. 조각 경계에서는 반올림 때문에
+  // density()가 이웃 벽돌의 복셀을 읽을 수 있으므로 f는 밀도를 m으로 자른다.
+  template <typename F>
+  void for_each_segment(const ray &r, double t_min, double t_max, F f) const;
+
+  int res[3];
+  int bricks[3];
+  int supers[3];
+  vec3 voxel_size;
+  vec3 brick_extent;
+  vec3 super_extent;
+  double max_density = 0;
+  std::vector<int> brick_offset; // 벽돌 -> voxels 안의 위치, -1 이면 빈 벽돌
+  std::vector<double> majorant;  // 벽돌마다의 최대 밀도
+  std::vector<double> super_majorant; // 큰 벽돌마다의 최대 밀도
+  std::vector<float> voxels;
+};
+
+grid_medium::grid_medium(const aabb &box, int nx, int ny, int nz,
+                         shared_ptr<material> p)
+    : bounds(box), phase(p), res{nx, ny, nz} {
+  for (int a = 0; a < 3; a++) {
+    bricks[a] = (res[a] + brick_size - 1) / brick_size;
+    voxel_size[a] = (bounds.max()[a] - bounds.min()[a]) / res[a];
+    brick_extent[a] = voxel_size[a] * brick_size;
+    supers[a] = (bricks[a] + super_size - 1) / super_size;
+    super_extent[a] = brick_extent[a] * super_size;
+  }
+  brick_offset.assign(bricks[0] * bricks[1] * bricks[2], -1);
+  majorant.assign(brick_offset.size(), 0.0);
+  super_majorant.assign(supers[0] * supers[1] * supers[2], 0.0);
+}
+
+void grid_medium::set(int ix, int iy, int iz, double d) {
+  int b = brick_index(ix / brick_size, iy / brick_size, iz / brick_size);
+  if (brick_offset[b] < 0) {
+    if (d <= 0)
+      return;
+    brick_offset[b] = static_cast<int>(voxels.size());
+    voxels.resize(voxels.size() + brick_voxels, 0.0f);
+  }
+
+  int lx = ix % brick_size, ly = iy % brick_size, lz = iz % brick_size;
+  voxels[brick_offset[b] + (lz * brick_size + ly) * brick_size + lx] =
+      static_cast<float>(d);
+  majorant[b] = fmax(majorant[b], d);
+  int sb = super_index(ix / brick_size / super_size,
+                       iy / brick_size / super_size,
+                       iz / brick_size / super_size);
+  super_majorant[sb] = fmax(super_majorant[sb], d);
+  max_density = fmax(max_density, d);
+}
+
+double grid_medium::density(const point3 &p) const {
+  int v[3];
+  for (int a = 0; a < 3; a++) {
+    v[a] = static_cast<int>((p[a] - bounds.min()[a]) / voxel_size[a]);
+    v[a] = std::min(std::max(v[a], 0), res[a] - 1);
+  }
+
+  int offset = brick_offset[brick_index(
+      v[0] / brick_size, v[1] / brick_size, v[2] / brick_size)];
+  if (offset < 0)
+    return 0.0;
+  int lx = v[0] % brick_size, ly = v[1] % brick_size, lz = v[2] % brick_size;
+  return voxels[offset + (lz * brick_size + ly) * brick_size + lx];
+}
+
+template <typename F>
+bool grid_medium::walk_cells(const ray &r, double t_min, double t_max,
+                             const vec3 &extent, const int lo[3],
+                             const int hi[3], F f) const {
+  // 3D DDA (Amanatides & Woo)
+  point3 p = r.at(t_min);
+  vec3 d = r.direction();
+  int cell[3], step[3], limit[3];
+  double t_next[3], t_delta[3];
+
+  for (int a = 0; a < 3; a++) {
+    cell[a] = static_cast<int>((p[a] - bounds.min()[a]) / extent[a]);
+    cell[a] = std::min(std::max(cell[a], lo[a]), hi[a] - 1);
+    auto lower = bounds.min()[a] + cell[a] * extent[a];
+
+    if (d[a] > 0) {
+      step[a] = 1;
+      limit[a] = hi[a];
+      t_next[a] = t_min + (lower + extent[a] - p[a]) / d[a];
+      t_delta[a] = extent[a] / d[a];
+    } else if (d[a] < 0) {
+      step[a] = -1;
+      limit[a] = lo[a] - 1;
+      t_next[a] = t_min + (lower - p[a]) / d[a];
+      t_delta[a] = -extent[a] / d[a];
+    } else {
+      step[a] = 0;
+      limit[a] = lo[a] - 1;
+      t_next[a] = infinity;
+      t_delta[a] = infinity;
+    }
+  }
+
+  auto t = t_min;
+  while (t < t_max) {
+    int axis = 0;
+    if (t_next[1] < t_next[axis])
+      axis = 1;
+    if (t_next[2] < t_next[axis])
+      axis = 2;
+
+    auto t_exit = fmin(t_next[axis], t_max);
+    if (t_exit > t && f(cell, t, t_exit))
+      return true;
+
+    t = t_exit;
+    cell[axis] += step[axis];
+    if (cell[axis] == limit[axis])
+      return false;
+    t_next[axis] += t_delta[axis];
+  }
+  return false;
+}
+
+template <typename F>
+void grid_medium::for_each_segment(const ray &r, double t_min, double t_max,
+                                   F f) const {
+  if (!bounds.clip(r, t_min, t_max))
+    return;
+
+  if (!brick_majorants) {
+    if (max_density > 0)
+      f(t_min, t_max, max_density);
+    return;
+  }
+
+  auto brick = [&](const int *cell, double t0, double t1) {
+    auto m = majorant[brick_index(cell[0], cell[1], cell[2])];
+    return m > 0 && f(t0, t1, m);
+  };
+
+  const int zero[3] = {0, 0, 0};
+  if (!super_bricks) {
+    walk_cells(r, t_min, t_max, brick_extent, zero, bricks, brick);
+    return;
+  }
+
+  walk_cells(r, t_min, t_max, super_extent, zero, supers,
+             [&](const int *cell, double t0, double t1) {
+               if (super_majorant[super_index(cell[0], cell[1], cell[2])] <= 0)
+                 return false;
+               int lo[3], hi[3];
+               for (int a = 0; a < 3; a++) {
+                 lo[a] = cell[a] * super_size;
+                 hi[a] = std::min(lo[a] + super_size, bricks[a]);
+               }
+               return walk_cells(r, t0, t1, brick_extent, lo, hi, brick);
+             });
+}
+
+bool grid_medium::hit(const ray &r, double t_min, double t_max,
+                      hit_record &rec) const {
+  auto ray_length = r.direction().length();
+  bool hit_anything = false;
+
+  // delta tracking: majorant로 가상의 충돌을 고르고, 실제 밀도/majorant의
+  // 확률로 진짜 충돌로 받아들인다.
+  for_each_segment(r, t_min, t_max, [&](double t0, double t1, double m) {
+    auto t = t0;
+    while (true) {
+      t -= log(1 - random_double()) / (m * ray_length);
+      if (t >= t1)
+        return false;
+      if (random_double() * m < std::min(density(r.at(t)), m)) {
+        set_medium_record(r, t, phase, rec);
+        hit_anything = true;
+        return true;
+      }
+    }
+  });
+
+  return hit_anything;
+}
+
+double grid_medium::transmittance(const ray &r, double t_min,
+                                  double t_max) const {
+  auto ray_length = r.direction().length();
+  double tr = 1.0;
+
+  // ratio tracking: 가상의 충돌마다 (1 - 밀도/majorant)를 곱한다.
+  // 투과율이 작아지면 러시안 룰렛으로 일찍 끝낸다.
+  for_each_segment(r, t_min, t_max, [&](double t0, double t1, double m) {
+    auto t = t0;
+    while (true) {
+      t -= log(1 - random_double()) / (m * ray_length);
+      if (t >= t1)
+        return false;
+      tr *= 1 - std::min(density(r.at(t)), m) / m;
+      if (tr < 0.1) {
+        if (random_double() < 0.5) {
+          tr = 0;
+          return true;
+        }
+        tr *= 2;
+      }
+    }
+  });
+
+  return tr;
+}
+
+// 태양처럼 아주 멀리 있는 방향광. 그림자 광선의 목표가 된다.
+struct directional_light {
+  vec3 direction; // 빛이 오는 쪽을 향하는 단위 벡터
+  color radiance;
+};
+
+#endif